@@ -1,4 +1,6 @@
 #include <opencv2/opencv.hpp>
+#include "rawmat.hpp"
+#include "trace.hpp"
 
 auto shiftDFT(cv::Mat const & img) {
     // crop the spectrum, if it has an odd number of rows or columns
@@ -24,6 +26,8 @@ auto shiftDFT(cv::Mat const & img) {
 }
 
 auto getDFT(cv::Mat const & img) {
+    TRACE_SCOPE("dft");
+
     //expand input image to optimal size
     cv::Size dftSize;
     dftSize.width = cv::getOptimalDFTSize( img.cols );
@@ -38,8 +42,11 @@ auto getDFT(cv::Mat const & img) {
 
     cv::Mat dft_img; // output: complex image
 
+    // floating point input (e.g. from a raw container) is already in [0, 1]
+    double scale = (img.depth() == CV_32F || img.depth() == CV_64F) ? 1.0 : 1.0 / 255.0;
+
     cv::Mat float_img;
-    padded_img.convertTo(float_img, CV_32F, 1.0 / 255.0);
+    padded_img.convertTo(float_img, CV_32F, scale);
 
     cv::dft(float_img, dft_img, cv::DFT_COMPLEX_OUTPUT);
 
@@ -90,6 +97,7 @@ auto makeBinImageFromText(std::string text) {
 // auto blend_multiply
 
 int main(int argc, char * argv[]) {
+    trace::Session session(argc, argv);   // --trace <file>, --stats
     _putenv("QT_AUTO_SCREEN_SCALE_FACTOR=1");
 
     auto keys = 
@@ -99,7 +107,7 @@ int main(int argc, char * argv[]) {
         "{visual         |       | Use imshow to visualize process and result }"
         "{text           |abcdef | Text to be written, default to 'abcdef' }"
         "{@in            |<none> | Input image's path }"
-        "{@out           |out.png| Result image's path, default to 'out.png' }";
+        "{@out           |out.png| Result image's path, default to 'out.png'; '.rawmat' keeps the CV_32F result }";
     
     cv::CommandLineParser parser(argc, argv, keys);
     parser.about("Blind Watermark v1.0.0");
@@ -144,7 +152,11 @@ int main(int argc, char * argv[]) {
         return 0;
     }
     
-    cv::Mat img = cv::imread(input_image_path, cv::IMREAD_UNCHANGED);
+    cv::Mat img;
+    {
+        TRACE_SCOPE("imread");
+        img = readImage(input_image_path, cv::IMREAD_UNCHANGED);
+    }
     cv::Mat out;
 
     if (img.empty()) {
@@ -155,8 +167,11 @@ int main(int argc, char * argv[]) {
     std::cout << input_image_path << ": " << img.size() << " Channels: " << img.channels() << "\n";
     std::cout << "Image loaded successfully." << std::endl;
 
-    if (img.type() == CV_8UC3) cv::cvtColor(img, img, cv::COLOR_BGR2GRAY);
-    if (img.type() == CV_8UC4) cv::cvtColor(img, img, cv::COLOR_BGRA2GRAY);
+    if (img.channels() == 3) cv::cvtColor(img, img, cv::COLOR_BGR2GRAY);
+    if (img.channels() == 4) cv::cvtColor(img, img, cv::COLOR_BGRA2GRAY);
+
+    // a raw container skips the 8-bit quantisation of the result
+    auto raw_out = isRawMatPath(output_image_path);
 
     auto dft_img = getDFT(img); // dft_img is a complex_image (2 channels, real and imagine parts)
 
@@ -212,10 +227,17 @@ int main(int argc, char * argv[]) {
         auto modified_dft_img = shiftDFT(getComplexImageFromMagPh(modified_mag, phase)); // complex image
         
         cv::Mat modified_img;  // real image
-        cv::idft(modified_dft_img, modified_img, cv::DFT_REAL_OUTPUT);
+        {
+            TRACE_SCOPE("idft");
+            cv::idft(modified_dft_img, modified_img, cv::DFT_REAL_OUTPUT);
+        }
         
         cv::normalize(modified_img, modified_img, 0, 1, cv::NormTypes::NORM_MINMAX);
-        modified_img.convertTo(out, CV_8UC1, 255);
+        if (raw_out) {
+            out = modified_img;
+        } else {
+            modified_img.convertTo(out, CV_8UC1, 255);
+        }
         
         std::cout << "Input image size: " << img.size() << "\n" << "Result image size: " << out.size();
 
@@ -236,10 +258,15 @@ int main(int argc, char * argv[]) {
         if (visual) {
             cv::waitKey(0);
         }
-        log_mag.convertTo(out, CV_8UC1, 255);
+        if (raw_out) {
+            out = log_mag;
+        } else {
+            log_mag.convertTo(out, CV_8UC1, 255);
+        }
     }
     
-    cv::imwrite(output_image_path, out);
+    TRACE_SCOPE("imwrite");
+    writeImage(output_image_path, out);
 
     return 0;
 }
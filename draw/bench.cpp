@@ -0,0 +1,114 @@
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fmt/core.h>
+#include <opencv2/core.hpp>
+#include "geometry.hpp"
+
+// Compares the batch kernels in geometry.cpp against the former
+// per-point cv::Point2d implementation of `polygon`.
+
+namespace {
+
+// the way `polygon` used to generate its vertices
+std::vector<cv::Point2d> scalarPolygon(const cv::Point2d& center, double r, double deg, double degDelta, int n) {
+    std::vector<cv::Point2d> pts;
+    for (int i = 0; i < n; ++i) {
+        pts.push_back({center.x - r * std::cos(deg), center.y - r * std::sin(deg)});
+        deg += degDelta;
+    }
+    return pts;
+}
+
+// the way `gen_` used to interpolate the nested polygons
+void scalarNested(std::vector<std::vector<cv::Point2d>>& levels, std::vector<cv::Point2d> oldPts, int depth, double ratio) {
+    if (depth <= 0) return;
+    auto n = oldPts.size();
+    std::vector<cv::Point2d> newPts;
+    for (int i = 0; i < n; ++i) {
+        auto newPoint = oldPts[i] + ratio * (oldPts[(i+1)%n] - oldPts[i]);
+        newPts.push_back(newPoint);
+    }
+    levels.push_back(newPts);
+    scalarNested(levels, std::move(newPts), depth - 1, ratio);
+}
+
+template <typename F>
+double bestOf(int repeat, F&& f) {
+    double best = 1e300;
+    for (int i = 0; i < repeat; ++i) {
+        auto t0 = std::chrono::steady_clock::now();
+        f();
+        auto t1 = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(t1 - t0).count());
+    }
+    return best;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    std::string usage = "./draw-bench [edges=1000000, [depth=8, [ratio=0.2, [repeat=5]]]]\n";
+
+    int n = 1000000, depth = 8, repeat = 5;
+    double ratio = 0.2;
+    try {
+        if (argc > 1) n = std::stoi(argv[1]);
+        if (argc > 2) depth = std::stoi(argv[2]);
+        if (argc > 3) ratio = std::stod(argv[3]);
+        if (argc > 4) repeat = std::stoi(argv[4]);
+    } catch (const std::exception&) {
+        std::cerr << "Illegal arguments. Usage:\n" << usage << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (n < 3 || depth < 1 || repeat < 1) {
+        std::cerr << "Illegal arguments. Usage:\n" << usage << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    cv::Point2d center{250, 250};
+    double r = 200, deg = 0.3;
+    double degDelta = 2 * CV_PI / n;
+
+    std::vector<std::vector<cv::Point2d>> scalarLevels;
+    PointsSoA soa(static_cast<std::size_t>(n) * depth);
+
+    auto scalarGen = bestOf(repeat, [&] {
+        scalarLevels.clear();
+        scalarLevels.push_back(scalarPolygon(center, r, deg, degDelta, n));
+    });
+    auto batchGen = bestOf(repeat, [&] {
+        regularPolygonVertices(center.x, center.y, -r, deg, degDelta, n, soa.x.data(), soa.y.data());
+    });
+
+    auto scalarNest = bestOf(repeat, [&] {
+        scalarLevels.resize(1);
+        scalarNested(scalarLevels, scalarLevels[0], depth - 1, ratio);
+    });
+    auto batchNest = bestOf(repeat, [&] {
+        nestedPolygonVertices(soa.x.data(), soa.y.data(), n, depth, ratio);
+    });
+
+    // maximum deviation between both implementations
+    double maxErr = 0;
+    for (int l = 0; l < depth; ++l) {
+        for (int i = 0; i < n; ++i) {
+            auto k = static_cast<std::size_t>(l) * n + i;
+            maxErr = std::max(maxErr, std::abs(scalarLevels[l][i].x - soa.x[k]));
+            maxErr = std::max(maxErr, std::abs(scalarLevels[l][i].y - soa.y[k]));
+        }
+    }
+
+    auto total = static_cast<double>(n) * depth;
+    std::cout
+        << fmt::format("- Vertices: {} edges x {} levels = {:.0f}\n", n, depth, total)
+        << fmt::format("- Generate:    scalar {:8.2f} ms | batch {:8.2f} ms | x{:.1f}\n",
+                       scalarGen, batchGen, scalarGen / batchGen)
+        << fmt::format("- Interpolate: scalar {:8.2f} ms | batch {:8.2f} ms | x{:.1f}\n",
+                       scalarNest, batchNest, scalarNest / batchNest)
+        << fmt::format("- Max deviation: {:.3e}\n", maxErr);
+
+    return EXIT_SUCCESS;
+}
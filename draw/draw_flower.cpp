@@ -1,18 +1,23 @@
 #include "draw.hpp"
+#include "geometry.hpp"
+#include "trace.hpp"
 
 Elements flower(const cv::Point2d& base, int width, int n) {
+    if (n < 1) return {};
+    TRACE_SCOPE("geometry");
 
     cv::Point2d center{base.x + width / 2.0, base.y + width / 2.0};
 
     auto radius = width / 2.0;
 
-    std::vector<cv::Point2d> pts;
-    double deg = 0;
     double degDelta = 2 * CV_PI / n;
 
+    PointsSoA soa(n);
+    regularPolygonVertices(center.x, center.y, radius, 0, degDelta, n, soa.x.data(), soa.y.data());
+
+    std::vector<cv::Point2d> pts;
     for (int i = 0; i < n; ++i) {
-        pts.emplace_back(center.x + std::cos(deg) * radius, center.y + std::sin(deg) * radius);
-        deg += degDelta;
+        pts.emplace_back(soa.x[i], soa.y[i]);
     }
 
     Elements elements;
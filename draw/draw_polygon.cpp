@@ -1,22 +1,10 @@
 #include "draw.hpp"
-
-void gen_(Elements & elements, std::vector<cv::Point2d> & oldPts, int depth, double ratio) {
-    if (depth <= 0) return;
-    auto n = oldPts.size();
-    std::vector<cv::Point2d> newPts;
-    for (int i = 0; i < n; ++i) {
-        auto newPoint = oldPts[i] + ratio * (oldPts[(i+1)%n] - oldPts[i]);
-        newPts.push_back(newPoint);
-    }
-    gen_(elements, newPts, depth - 1, ratio);
-    elements.push_back(std::make_shared<Polygon>(std::move(newPts)));
-}
+#include "geometry.hpp"
+#include "trace.hpp"
 
 Elements polygon(const cv::Point2d& center, const cv::Point2d& a, int n, int depth, double ratio) {
     if (n < 3) return {};
-
-    auto innerAngle = (180.0 - 360.0 / n) / CV_PI;
-    std::vector<cv::Point2d> pts;
+    TRACE_SCOPE("geometry");
 
     auto dist = [](const cv::Point2d& a, const cv::Point2d& b) {
         auto d = a - b;
@@ -28,14 +16,25 @@ Elements polygon(const cv::Point2d& center, const cv::Point2d& a, int n, int dep
     auto deg = std::atan(diff.y / diff.x);
     auto degDelta = (360.0 / n) / 180.0 * CV_PI;
 
-    for (int i = 0; i < n; ++i) {
-        pts.push_back({center.x - r * std::cos(deg), center.y - r * std::sin(deg)});
-        deg += degDelta;
-    }
+    // all nested polygons are generated at once, level by level, into one SoA buffer
+    int levels = std::max(depth, 1);
+    PointsSoA soa(static_cast<std::size_t>(n) * levels);
+
+    // vertices are `center - r * (cos, sin)`, i.e. a circle of radius -r
+    regularPolygonVertices(center.x, center.y, -r, deg, degDelta, n, soa.x.data(), soa.y.data());
+    nestedPolygonVertices(soa.x.data(), soa.y.data(), n, levels, ratio);
 
+    // innermost polygon first, the outer one last
     Elements elements;
-    gen_(elements, pts, depth - 1, ratio);
-    elements.emplace_back(std::make_shared<Polygon>(std::move(pts)));
+    for (int l = levels - 1; l >= 0; --l) {
+        std::vector<cv::Point2d> pts;
+        pts.reserve(n);
+        auto offset = static_cast<std::size_t>(l) * n;
+        for (int i = 0; i < n; ++i) {
+            pts.emplace_back(soa.x[offset + i], soa.y[offset + i]);
+        }
+        elements.emplace_back(std::make_shared<Polygon>(std::move(pts)));
+    }
 
     return elements;
 }
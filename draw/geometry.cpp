@@ -0,0 +1,59 @@
+#include "geometry.hpp"
+#include <cmath>
+
+namespace {
+    // Number of vertices sharing one exact cos/sin evaluation. Large enough
+    // that the compiler keeps the inner loops as (vectorised) loops rather
+    // than unrolling them completely.
+    constexpr std::size_t BLOCK = 64;
+}
+
+void regularPolygonVertices(double cx, double cy, double r, double phase, double step,
+                            std::size_t n, double* __restrict xs, double* __restrict ys) {
+    // cos/sin of k * step, for k in [0, BLOCK)
+    double ct[BLOCK], st[BLOCK];
+    for (std::size_t k = 0; k < BLOCK; ++k) {
+        ct[k] = std::cos(k * step);
+        st[k] = std::sin(k * step);
+    }
+
+    std::size_t i = 0;
+    for (; i + BLOCK <= n; i += BLOCK) {
+        // the base angle is evaluated exactly for each block, so no error accumulates
+        double deg = phase + i * step;
+        double cb = r * std::cos(deg);
+        double sb = r * std::sin(deg);
+        double* __restrict x = xs + i;
+        double* __restrict y = ys + i;
+        // x and y in separate loops, so that each is a plain vectorisable stream
+        for (std::size_t k = 0; k < BLOCK; ++k) {
+            x[k] = cx + (cb * ct[k] - sb * st[k]);
+        }
+        for (std::size_t k = 0; k < BLOCK; ++k) {
+            y[k] = cy + (sb * ct[k] + cb * st[k]);
+        }
+    }
+    for (; i < n; ++i) {
+        double deg = phase + i * step;
+        xs[i] = cx + r * std::cos(deg);
+        ys[i] = cy + r * std::sin(deg);
+    }
+}
+
+void interpolateRing(const double* __restrict xs, const double* __restrict ys, std::size_t n, double ratio,
+                     double* __restrict outX, double* __restrict outY) {
+    if (n == 0) return;
+    // the wrap-around edge is handled separately to keep the modulo out of the loop
+    for (std::size_t i = 0; i + 1 < n; ++i) {
+        outX[i] = xs[i] + ratio * (xs[i+1] - xs[i]);
+        outY[i] = ys[i] + ratio * (ys[i+1] - ys[i]);
+    }
+    outX[n-1] = xs[n-1] + ratio * (xs[0] - xs[n-1]);
+    outY[n-1] = ys[n-1] + ratio * (ys[0] - ys[n-1]);
+}
+
+void nestedPolygonVertices(double* xs, double* ys, std::size_t n, int levels, double ratio) {
+    for (int l = 1; l < levels; ++l) {
+        interpolateRing(xs + (l-1) * n, ys + (l-1) * n, n, ratio, xs + l * n, ys + l * n);
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Batch kernels for vertex generation, working on SoA (separate x / y) arrays
+// so that the inner loops are vectorised by the compiler (-O3 / Release,
+// which draw/CMakeLists.txt defaults to).
+
+struct PointsSoA {
+    std::vector<double> x;
+    std::vector<double> y;
+
+    PointsSoA() = default;
+    explicit PointsSoA(std::size_t n) : x(n), y(n) {}
+
+    std::size_t size() const { return x.size(); }
+    void resize(std::size_t n) { x.resize(n); y.resize(n); }
+};
+
+// Writes n points on a circle: (cx + r * cos(phase + i * step), cy + r * sin(phase + i * step)).
+// Uses a small precomputed trig table per block instead of n cos/sin calls.
+void regularPolygonVertices(double cx, double cy, double r, double phase, double step,
+                            std::size_t n, double* xs, double* ys);
+
+// For every edge (i, i+1) of the closed polygon, writes the point at `ratio` along that edge.
+void interpolateRing(const double* xs, const double* ys, std::size_t n, double ratio,
+                     double* outX, double* outY);
+
+// xs / ys hold `levels` consecutive polygons of n vertices each; level 0 must be filled in.
+// Each following level is interpolated from the previous one.
+void nestedPolygonVertices(double* xs, double* ys, std::size_t n, int levels, double ratio);
@@ -1,9 +1,11 @@
 #include "draw.hpp"
+#include "trace.hpp"
 #include <fstream>
 #include <stdlib.h>
 
 int main(int argc, char* argv[]) {
 
+    trace::Session session(argc, argv);   // --trace <file>, --stats
     _putenv("QT_AUTO_SCREEN_SCALE_FACTOR=1");
 
     cv::Size size{500, 500};
@@ -58,18 +60,27 @@ int main(int argc, char* argv[]) {
         return EXIT_FAILURE;
     }
 
-    std::ofstream ofs(command + ".svg");
-    if (ofs.is_open()) {
-        svgToStream(ofs, size, elements);
-        ofs.close();
-    } else {
-        std::cerr << fmt::format("Unable to open {}.\n", command + ".svg");
+    {
+        TRACE_SCOPE("svg export");
+        std::ofstream ofs(command + ".svg");
+        if (ofs.is_open()) {
+            svgToStream(ofs, size, elements);
+            ofs.close();
+        } else {
+            std::cerr << fmt::format("Unable to open {}.\n", command + ".svg");
+        }
     }
 
-    for (const auto& e : elements) {
-        e->drawOn(pic);
+    {
+        TRACE_SCOPE("rasterise");
+        for (const auto& e : elements) {
+            e->drawOn(pic);
+        }
+    }
+    {
+        TRACE_SCOPE("imwrite");
+        cv::imwrite(command + ".png", pic);
     }
-    cv::imwrite(command + ".png", pic);
 
     cv::namedWindow(command, cv::WINDOW_NORMAL);
     cv::imshow(command, pic);
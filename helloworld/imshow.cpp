@@ -1,28 +1,233 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <functional>
 #include <iostream>
+#include <stdexcept>
+#include <vector>
+#include <opencv2/core/utility.hpp>
 #include <opencv2/highgui.hpp>
+#include "tile_cache.hpp"
+#include "trace.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+double msSince(Clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+struct Viewport {
+    cv::Point2d center;     // in image coordinates
+    double zoom;            // screen pixels per image pixel
+};
+
+const double MAX_ZOOM = 32;
+
+// Fallback tile cache for images in directories that can't be written to:
+// one file per image path, in the temp directory.
+std::string tempCachePath(const std::string& imagePath) {
+    namespace fs = std::filesystem;
+    auto key = std::hash<std::string>{}(fs::absolute(imagePath).string());
+    return (fs::temp_directory_path() / ("imshow-" + std::to_string(key) + ".tiles")).string();
+}
+
+// zoom level at which the whole image fits the frame
+double fitZoom(cv::Size image, cv::Size frame) {
+    return std::min(static_cast<double>(frame.width) / image.width,
+                    static_cast<double>(frame.height) / image.height);
+}
+
+// Scripted pan / zoom path: zoom in from "fit" to 1:1 at the center, pan a
+// lap around the center, then zoom back out.
+std::vector<Viewport> benchPath(cv::Size image, cv::Size frame) {
+    std::vector<Viewport> path;
+    cv::Point2d center{image.width / 2.0, image.height / 2.0};
+    auto fit = fitZoom(image, frame);
+
+    for (double z = fit; z < 1; z *= 2) {
+        path.push_back({center, z});
+    }
+    path.push_back({center, 1});
+
+    const int steps = 8;
+    double dx = frame.width / 2.0, dy = frame.height / 2.0;
+    cv::Point2d p = center;
+    for (auto d : {cv::Point2d{dx, 0}, cv::Point2d{0, dy}, cv::Point2d{-dx, 0}, cv::Point2d{0, -dy}}) {
+        for (int i = 0; i < steps; ++i) {
+            p += d;
+            path.push_back({p, 1});
+        }
+    }
+
+    for (double z = 0.5; z > fit; z /= 2) {
+        path.push_back({center, z});
+    }
+    path.push_back({center, fit});
+    return path;
+}
+
+int runBench(TileCache const & cache, cv::Size frameSize) {
+    auto path = benchPath(cache.size(), frameSize);
+    cv::Mat frame(frameSize, cache.type());
+
+    std::vector<double> latencies;
+    std::cout << "step\tzoom\ttiles\tms\n";
+    for (size_t i = 0; i < path.size(); ++i) {
+        auto t0 = Clock::now();
+        auto tiles = cache.render(frame, path[i].center, path[i].zoom);
+        auto ms = msSince(t0);
+        latencies.push_back(ms);
+        std::cout << i << "\t" << path[i].zoom << "\t" << tiles << "\t" << ms << "\n";
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) {
+        return latencies[static_cast<size_t>(p * (latencies.size() - 1))];
+    };
+    std::cout << "Frames: " << latencies.size()
+              << "; min: " << latencies.front() << " ms"
+              << "; median: " << percentile(0.5) << " ms"
+              << "; p95: " << percentile(0.95) << " ms"
+              << "; max: " << latencies.back() << " ms" << std::endl;
+    return 0;
+}
+
+struct ViewerState {
+    Viewport view;
+    cv::Size frameSize;
+    double minZoom;
+    cv::Point drag{-1, -1};
+    bool dirty = true;
+};
+
+void zoomAt(ViewerState& s, cv::Point screen, double factor) {
+    auto z = std::clamp(s.view.zoom * factor, s.minZoom, MAX_ZOOM);
+    // keep the image point under the cursor in place
+    cv::Point2d offset(screen.x - s.frameSize.width / 2.0, screen.y - s.frameSize.height / 2.0);
+    s.view.center += offset * (1 / s.view.zoom - 1 / z);
+    s.view.zoom = z;
+    s.dirty = true;
+}
+
+int runViewer(TileCache const & cache, std::string const & winName, cv::Size frameSize) {
+    ViewerState state;
+    state.frameSize = frameSize;
+    auto fit = fitZoom(cache.size(), frameSize);
+    state.view = { {cache.size().width / 2.0, cache.size().height / 2.0}, fit };
+    state.minZoom = std::min(fit, 1.0);
+
+    cv::namedWindow(winName, cv::WINDOW_AUTOSIZE);
+    cv::setMouseCallback(winName, [](int event, int x, int y, int flags, void* data) {
+        auto& s = *static_cast<ViewerState*>(data);
+        switch (event) {
+        case cv::EVENT_LBUTTONDOWN:
+            s.drag = {x, y};
+            break;
+        case cv::EVENT_MOUSEMOVE:
+            if (s.drag.x >= 0) {
+                s.view.center -= cv::Point2d(x - s.drag.x, y - s.drag.y) / s.view.zoom;
+                s.drag = {x, y};
+                s.dirty = true;
+            }
+            break;
+        case cv::EVENT_LBUTTONUP:
+            s.drag = {-1, -1};
+            break;
+        case cv::EVENT_MOUSEWHEEL:
+            zoomAt(s, {x, y}, cv::getMouseWheelDelta(flags) > 0 ? 1.25 : 0.8);
+            break;
+        }
+    }, &state);
+
+    std::cout << "Drag or use WASD to pan, mouse wheel or +/- to zoom, 0 to fit, 1 for 1:1, q to quit." << std::endl;
+
+    cv::Mat frame(frameSize, cache.type());
+    auto center = cv::Point(frameSize.width / 2, frameSize.height / 2);
+    while (true) {
+        if (state.dirty) {
+            cache.render(frame, state.view.center, state.view.zoom);
+            cv::imshow(winName, frame);
+            state.dirty = false;
+        }
+
+        auto key = cv::waitKey(15);
+        if (key < 0) continue;
+        auto step = frameSize.width / 4.0 / state.view.zoom;
+        switch (key & 0xff) {
+        case 'q': case 27:
+            return 0;
+        case 'w': state.view.center.y -= step; break;
+        case 's': state.view.center.y += step; break;
+        case 'a': state.view.center.x -= step; break;
+        case 'd': state.view.center.x += step; break;
+        case '+': case '=': zoomAt(state, center, 2); break;
+        case '-': zoomAt(state, center, 0.5); break;
+        case '0': state.view = { {cache.size().width / 2.0, cache.size().height / 2.0}, fit }; break;
+        case '1': state.view.zoom = 1; break;
+        default: continue;
+        }
+        state.dirty = true;
+    }
+}
 
 int main(int argc, char *argv[])
 {
-    std::string filename;
-    if (argc == 2) {
-        filename = argv[1];
-    } else {
+    trace::Session session(argc, argv);   // --trace <file>, --stats
+
+    auto keys =
+        "{help h ?  |       | Print this message }"
+        "{@image    |       | Image's path }"
+        "{cache     |       | Tile cache's path, default to '<image>.tiles' (or the temp directory if not writable) }"
+        "{tile      |256    | Tile size in pixels }"
+        "{width     |1280   | Viewport width }"
+        "{height    |800    | Viewport height }"
+        "{bench     |       | Headless: replay a pan / zoom path and report frame latency }";
+
+    cv::CommandLineParser parser(argc, argv, keys);
+    parser.about("Tiled image viewer. Writes a tile cache file (see --cache) the first time an image is opened.");
+
+    if (parser.has("help")) {
+        parser.printMessage();
+        return 0;
+    }
+
+    auto filename = parser.get<std::string>("@image");
+    auto cachePath = parser.get<std::string>("cache");
+    auto tileSize = parser.get<int>("tile");
+    auto frameSize = cv::Size(parser.get<int>("width"), parser.get<int>("height"));
+    auto bench = parser.has("bench");
+
+    if (!parser.check() || tileSize <= 0 || frameSize.empty()) {
+        parser.printMessage();
+        parser.printErrors();
+        return EXIT_FAILURE;
+    }
+
+    if (filename.empty()) {
         std::cout << "Input Filename: ";
         std::cin >> filename;
     }
 
-    cv::Mat img = cv::imread(filename, cv::ImreadModes::IMREAD_UNCHANGED);
-
-    if (img.empty()) {
-        std::cout << "Unable to open '" << filename << "'." << std::endl;
+    auto t0 = Clock::now();
+    TileCache cache;
+    try {
+        std::vector<std::string> cachePaths{cachePath};
+        if (cachePath.empty()) {
+            cachePaths = {filename + ".tiles", tempCachePath(filename)};
+        }
+        cache = TileCache::open(filename, cachePaths, tileSize);
+    } catch (const std::exception& e) {
+        std::cout << e.what() << std::endl;
         return EXIT_FAILURE;
     }
 
     std::cout << "Image loaded successfully." << std::endl;
+    std::cout << filename << ": " << cache.size() << "; " << cache.levels() << " levels; "
+              << (cache.wasBuilt() ? "tile cache built in " : "tile cache opened in ")
+              << msSince(t0) << " ms (" << cache.path() << ")" << std::endl;
 
-    cv::namedWindow(filename, cv::WINDOW_NORMAL);
-    cv::imshow(filename, img);
-    cv::waitKey(0);
-
-    return 0;
+    if (bench) {
+        return runBench(cache, frameSize);
+    }
+    return runViewer(cache, filename, frameSize);
 }
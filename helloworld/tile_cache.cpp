@@ -0,0 +1,266 @@
+#include "tile_cache.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <opencv2/imgproc.hpp>
+#include "rawmat.hpp"
+#include "trace.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char MAGIC[8] = {'P', 'W', 'O', 'T', 'I', 'L', 'E', 'S'};
+constexpr std::uint32_t VERSION = 1;
+
+// tile data starts at a page boundary
+constexpr std::size_t DATA_OFFSET = 4096;
+
+struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::int32_t tileSize;
+    std::int32_t width;
+    std::int32_t height;
+    std::int32_t type;
+    std::int32_t levels;
+    std::uint64_t sourceSize;
+    std::int64_t sourceTime;
+};
+
+// Copies `src` into the top-left corner of the tile `dst`, replicating its
+// border into the rest of the tile.
+void putTile(cv::Mat const & src, cv::Mat & dst) {
+    if (src.size() == dst.size()) {
+        src.copyTo(dst);
+    } else {
+        cv::copyMakeBorder(src, dst, 0, dst.rows - src.rows, 0, dst.cols - src.cols, cv::BORDER_REPLICATE);
+    }
+}
+
+}
+
+TileCache TileCache::open(const std::string& imagePath, std::vector<std::string> const & cachePaths,
+                          int tileSize) {
+    std::error_code ec;
+    auto sourceSize = fs::file_size(imagePath, ec);
+    if (ec) {
+        throw std::runtime_error("Unable to open '" + imagePath + "'.");
+    }
+    auto sourceTime = static_cast<std::int64_t>(fs::last_write_time(imagePath).time_since_epoch().count());
+
+    for (auto const & cachePath : cachePaths) {
+        TileCache cache;
+        if (cache.load(cachePath, sourceSize, sourceTime, tileSize)) {
+            cache.path_ = cachePath;
+            return cache;
+        }
+    }
+    TileCache cache;
+    cache.build(imagePath, cachePaths, sourceSize, sourceTime, tileSize);
+    return cache;
+}
+
+bool TileCache::load(const std::string& cachePath, std::uint64_t sourceSize, std::int64_t sourceTime, int tileSize) {
+    if (!fs::exists(cachePath)) return false;
+    TRACE_SCOPE("tile cache open");
+    try {
+        file_ = MappedFile(cachePath);
+    } catch (const std::runtime_error&) {
+        return false;
+    }
+    if (file_.size() < DATA_OFFSET) return false;
+
+    Header h;
+    std::memcpy(&h, file_.data(), sizeof(h));
+    if (std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0 || h.version != VERSION ||
+        h.tileSize != tileSize || h.sourceSize != sourceSize || h.sourceTime != sourceTime) {
+        return false;
+    }
+
+    width_ = h.width;
+    height_ = h.height;
+    type_ = h.type;
+    tileSize_ = h.tileSize;
+    layout();
+
+    // guards against truncated files
+    return levels_ == h.levels && file_.size() == DATA_OFFSET + levelOffsets_.back();
+}
+
+void TileCache::build(const std::string& imagePath, std::vector<std::string> const & cachePaths,
+                      std::uint64_t sourceSize, std::int64_t sourceTime, int tileSize) {
+    // The only full decode of the image (raw containers are just mapped);
+    // afterwards everything is read from the tiles.
+    cv::Mat img;
+    {
+        TRACE_SCOPE("imread");
+        img = readImage(imagePath, cv::ImreadModes::IMREAD_UNCHANGED);
+    }
+    if (img.empty()) {
+        throw std::runtime_error("Unable to open '" + imagePath + "'.");
+    }
+
+    width_ = img.cols;
+    height_ = img.rows;
+    type_ = img.type();
+    tileSize_ = tileSize;
+    layout();
+
+    // the image is decoded once, whichever location ends up holding the cache
+    std::string error = "No tile cache path given.";
+    for (auto const & cachePath : cachePaths) {
+        try {
+            file_ = MappedFile::create(cachePath, DATA_OFFSET + levelOffsets_.back());
+            path_ = cachePath;
+            break;
+        } catch (const std::runtime_error& e) {
+            error = e.what();
+        }
+    }
+    if (path_.empty()) {
+        throw std::runtime_error(error);
+    }
+    built_ = true;
+
+    auto T = tileSize_;
+    auto count = tileCount(0);
+    {
+        TRACE_SCOPE("tile cache write");
+        for (int ty = 0; ty < count.height; ++ty) {
+            for (int tx = 0; tx < count.width; ++tx) {
+                auto dst = tile(0, tx, ty);
+                auto rect = cv::Rect(tx * T, ty * T, T, T) & cv::Rect(0, 0, width_, height_);
+                putTile(img(rect), dst);
+            }
+        }
+        img.release();
+    }
+
+    // Each tile of level l is the 2x2 block of tiles beneath it, downsampled.
+    TRACE_SCOPE("pyramid build");
+    cv::Mat block(2 * T, 2 * T, type_);
+    cv::Mat half;
+    for (int l = 1; l < levels_; ++l) {
+        auto below = tileCount(l - 1);
+        auto levelSize = size(l);
+        count = tileCount(l);
+        for (int ty = 0; ty < count.height; ++ty) {
+            for (int tx = 0; tx < count.width; ++tx) {
+                block = cv::Scalar::all(0);
+                for (int dy = 0; dy < 2; ++dy) {
+                    for (int dx = 0; dx < 2; ++dx) {
+                        int cx = 2 * tx + dx, cy = 2 * ty + dy;
+                        if (cx < below.width && cy < below.height) {
+                            tile(l - 1, cx, cy).copyTo(block(cv::Rect(dx * T, dy * T, T, T)));
+                        }
+                    }
+                }
+                cv::resize(block, half, cv::Size(T, T), 0, 0, cv::INTER_AREA);
+                auto rect = cv::Rect(tx * T, ty * T, T, T) & cv::Rect(0, 0, levelSize.width, levelSize.height);
+                auto dst = tile(l, tx, ty);
+                putTile(half(rect - rect.tl()), dst);
+            }
+        }
+    }
+
+    // The header goes last, so that an interrupted build is never mistaken for a valid cache.
+    Header h{};
+    std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = VERSION;
+    h.tileSize = tileSize_;
+    h.width = width_;
+    h.height = height_;
+    h.type = type_;
+    h.levels = levels_;
+    h.sourceSize = sourceSize;
+    h.sourceTime = sourceTime;
+    std::memcpy(file_.data(), &h, sizeof(h));
+    file_.flush();
+}
+
+void TileCache::layout() {
+    tileBytes_ = static_cast<std::size_t>(tileSize_) * tileSize_ * CV_ELEM_SIZE(type_);
+    levels_ = 1;
+    while (std::max(size(levels_ - 1).width, size(levels_ - 1).height) > tileSize_) {
+        ++levels_;
+    }
+    // levelOffsets_[l] is where level l starts; the last entry is the total size
+    levelOffsets_.assign(1, 0);
+    for (int l = 0; l < levels_; ++l) {
+        auto count = tileCount(l);
+        levelOffsets_.push_back(levelOffsets_.back() + tileBytes_ * count.width * count.height);
+    }
+}
+
+cv::Size TileCache::size(int level) const {
+    int d = 1 << level;
+    return { (width_ + d - 1) / d, (height_ + d - 1) / d };
+}
+
+cv::Size TileCache::tileCount(int level) const {
+    auto s = size(level);
+    return { (s.width + tileSize_ - 1) / tileSize_, (s.height + tileSize_ - 1) / tileSize_ };
+}
+
+cv::Mat TileCache::tile(int level, int tx, int ty) const {
+    auto index = static_cast<std::size_t>(ty) * tileCount(level).width + tx;
+    auto p = file_.data() + DATA_OFFSET + levelOffsets_[level] + index * tileBytes_;
+    return cv::Mat(tileSize_, tileSize_, type_, p);
+}
+
+int TileCache::render(cv::Mat& frame, cv::Point2d center, double zoom) const {
+    CV_Assert(!frame.empty() && zoom > 0);
+    TRACE_SCOPE("render");
+    frame.create(frame.size(), type_);
+    frame = cv::Scalar::all(0);
+
+    // the coarsest level that still has at least one pixel per screen pixel
+    int level = std::clamp(static_cast<int>(std::floor(std::log2(1.0 / zoom))), 0, levels_ - 1);
+    double s = 1 << level;
+    double scale = zoom * s;    // screen pixels per pixel of `level`
+    auto levelSize = size(level);
+
+    // visible area in `level` coordinates
+    double lx0 = center.x / s - frame.cols / (2 * scale);
+    double ly0 = center.y / s - frame.rows / (2 * scale);
+    double lx1 = lx0 + frame.cols / scale;
+    double ly1 = ly0 + frame.rows / scale;
+
+    int ix0 = std::max(0, static_cast<int>(std::floor(lx0)));
+    int iy0 = std::max(0, static_cast<int>(std::floor(ly0)));
+    int ix1 = std::min(levelSize.width, static_cast<int>(std::ceil(lx1)));
+    int iy1 = std::min(levelSize.height, static_cast<int>(std::ceil(ly1)));
+    if (ix0 >= ix1 || iy0 >= iy1) return 0;
+
+    // gather the visible tiles
+    auto T = tileSize_;
+    auto area = cv::Rect(ix0, iy0, ix1 - ix0, iy1 - iy0);
+    cv::Mat region(area.size(), type_);
+    int tiles = 0;
+    for (int ty = iy0 / T; ty <= (iy1 - 1) / T; ++ty) {
+        for (int tx = ix0 / T; tx <= (ix1 - 1) / T; ++tx) {
+            auto rect = cv::Rect(tx * T, ty * T, T, T) & area;
+            tile(level, tx, ty)(rect - cv::Point(tx * T, ty * T)).copyTo(region(rect - area.tl()));
+            ++tiles;
+        }
+    }
+    trace::count("tiles", tiles);
+
+    // scale onto the screen
+    int dx0 = cvRound((ix0 - lx0) * scale), dx1 = cvRound((ix1 - lx0) * scale);
+    int dy0 = cvRound((iy0 - ly0) * scale), dy1 = cvRound((iy1 - ly0) * scale);
+    if (dx0 >= dx1 || dy0 >= dy1) return tiles;
+
+    cv::Mat scaled;
+    cv::resize(region, scaled, cv::Size(dx1 - dx0, dy1 - dy0), 0, 0,
+               scale >= 1 ? cv::INTER_NEAREST : cv::INTER_LINEAR);
+
+    auto dst = cv::Rect(dx0, dy0, dx1 - dx0, dy1 - dy0);
+    auto visible = dst & cv::Rect(0, 0, frame.cols, frame.rows);
+    scaled(visible - dst.tl()).copyTo(frame(visible));
+
+    return tiles;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+#include "mapped_file.hpp"
+
+// Multi-resolution tiled copy of an image, stored in a memory-mapped file.
+//
+// Level 0 has the size of the source image and every following level is half
+// the size of the previous one, until a level fits in a single tile. Each tile
+// is stored as a full `tileSize` x `tileSize` block (edge tiles are padded by
+// replicating the border), so a tile is a cv::Mat header over the mapping.
+class TileCache {
+public:
+    TileCache() = default;
+
+    // Opens the first of `cachePaths` that was built from the current `imagePath`
+    // with the same tile size. Otherwise (re)builds the cache at the first of
+    // them that can be created, so later paths serve as fallbacks.
+    // Throws std::runtime_error on failure.
+    static TileCache open(const std::string& imagePath, std::vector<std::string> const & cachePaths,
+                          int tileSize = 256);
+
+    int levels() const { return levels_; }
+    int type() const { return type_; }
+    int tileSize() const { return tileSize_; }
+    cv::Size size(int level = 0) const;
+    cv::Size tileCount(int level) const;
+
+    // Zero-copy view of one (padded) tile.
+    cv::Mat tile(int level, int tx, int ty) const;
+
+    // Renders the part of the image around `center` (level 0 coordinates) into
+    // `frame`, at `zoom` screen pixels per image pixel. Only the tiles of the
+    // pyramid level matching the zoom are read. Returns the number of tiles used.
+    int render(cv::Mat& frame, cv::Point2d center, double zoom) const;
+
+    bool wasBuilt() const { return built_; }
+    const std::string& path() const { return path_; }
+
+private:
+    bool load(const std::string& cachePath, std::uint64_t sourceSize, std::int64_t sourceTime, int tileSize);
+    void build(const std::string& imagePath, std::vector<std::string> const & cachePaths,
+               std::uint64_t sourceSize, std::int64_t sourceTime, int tileSize);
+    void layout();
+
+    MappedFile file_;
+    std::string path_;
+    int width_ = 0;
+    int height_ = 0;
+    int type_ = 0;
+    int tileSize_ = 0;
+    int levels_ = 0;
+    bool built_ = false;
+    std::size_t tileBytes_ = 0;
+    std::vector<std::size_t> levelOffsets_;
+};
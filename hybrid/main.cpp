@@ -1,4 +1,6 @@
 #include <opencv2/opencv.hpp>
+#include "rawmat.hpp"
+#include "trace.hpp"
 
 // wrapper for convenience
 auto pyrUp(cv::Mat const & a) {
@@ -14,6 +16,29 @@ auto pyrDown(cv::Mat const & a) {
     return dst;
 }
 
+// CV_32F copy of a; integer images are scaled to [0, 1]
+auto toFloat(cv::Mat const & a) {
+    cv::Mat dst;
+    a.convertTo(dst, CV_32F, (a.depth() == CV_32F || a.depth() == CV_64F) ? 1.0 : 1.0 / 255.0);
+    return dst;
+}
+
+// CV_8U version of a, for image codecs; CV_32F images are taken as [0, 1]
+auto toByte(cv::Mat const & a) {
+    if (a.depth() == CV_8U) return a;
+    cv::Mat dst;
+    a.convertTo(dst, CV_8U, 255);
+    return dst;
+}
+
+// gray version of a; single channel images are returned as is
+auto toGray(cv::Mat const & a) {
+    if (a.channels() == 1) return a;
+    cv::Mat dst;
+    cv::cvtColor(a, dst, a.channels() == 4 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+    return dst;
+}
+
 // wrapper for convenience
 auto buildGaussianPyramid(cv::Mat const & a, int maxLevel) {
     // G[0] is the same as a;
@@ -33,6 +58,7 @@ auto buildLaplacianPyramid(std::vector<cv::Mat> const & G) {
 }
 
 auto buildLaplacianPyramid(cv::Mat const & a, int maxLevel) {
+    TRACE_SCOPE("pyramid build");
     auto G = buildGaussianPyramid(a, maxLevel);
     return buildLaplacianPyramid(G);
 }
@@ -55,6 +81,7 @@ getLinearHybridImage(cv::Mat const & img1, double a, cv::Mat const & img2, doubl
     }
 
     // reconstruct
+    TRACE_SCOPE("pyramid reconstruct");
     auto result = L3[maxLayerLevel];
     for (auto i = maxLayerLevel - 1; i >= 0; --i) {
         result = pyrUp(result) + L3[i];
@@ -69,13 +96,14 @@ namespace fs = std::filesystem;
 
 int main(int argc, char *argv[])
 {
+    trace::Session session(argc, argv);   // --trace <file>, --stats
     _putenv("QT_AUTO_SCREEN_SCALE_FACTOR=1");
 
     auto keys = 
         "{help h ?  |       | Print this message               }"
         "{@image1   |<none> | First image's path               }"
         "{@image2   |<none> | Second image's path              }"
-        "{@image3   |out.png| Hybrid image's path              }"
+        "{@image3   |out.png| Hybrid image's path (.rawmat: raw) }"
         "{a weight  |0.5    | Weight of image_1; default 0.5   }"
         "{n layers  |3      | Max pyramid level; default to 3  }"
         "{gray      |       | Run on a single channel          }"
@@ -116,8 +144,12 @@ int main(int argc, char *argv[])
         << "- Write(& view) layers of pyramids: " << verbose << "\n"
         << "- Use 'imshow' to visualize result: " << visual << "\n";
 
-    auto img1 = cv::imread(imgPath1);
-    auto img2 = cv::imread(imgPath2);
+    cv::Mat img1, img2;
+    {
+        TRACE_SCOPE("imread");
+        img1 = readImage(imgPath1);
+        img2 = readImage(imgPath2);
+    }
 
     if (img1.empty()) {
         std::cout << "Unable to open '" << imgPath1 << "'." << std::endl;
@@ -142,6 +174,15 @@ int main(int argc, char *argv[])
         std::cout << std::flush;
     }
 
+    // A raw result keeps full precision instead of the 8-bit pyramid math, and
+    // inputs of different depths (e.g. a CV_32F raw image and a PNG) need a
+    // common one: both cases work in CV_32F, in [0, 1].
+    auto rawOut = isRawMatPath(imgPath3);
+    if (rawOut || img1.depth() != img2.depth()) {
+        img1 = toFloat(img1);
+        img2 = toFloat(img2);
+    }
+
     cv::Mat result;
 
     auto viewLapPyr = [&](MatVector const & L1, MatVector const & L2, std::string winNamePrefix = "") {
@@ -158,20 +199,19 @@ int main(int argc, char *argv[])
     };
 
     auto wirteOutLapPyr = [&](MatVector const & L1, MatVector const & L2) {
+        TRACE_SCOPE("imwrite");
         for (int i = 0; i <= n; ++i) {
             fs::create_directory("./hybrid-out/");
             fs::create_directory("./hybrid-out/img1/");
             fs::create_directory("./hybrid-out/img2/");
-            cv::imwrite(fmt::format("./hybrid-out/img1/L_{}.png", i), L1[i]);
-            cv::imwrite(fmt::format("./hybrid-out/img2/L_{}.png", i), L2[i]);
+            cv::imwrite(fmt::format("./hybrid-out/img1/L_{}.png", i), toByte(L1[i]));
+            cv::imwrite(fmt::format("./hybrid-out/img2/L_{}.png", i), toByte(L2[i]));
         }
     };
 
     if (gray || (img1.channels() != img2.channels())) {
-        if (img1.channels() != 1 || img2.channels() != 1) {
-            cv::cvtColor(img1, img1, cv::COLOR_BGR2GRAY);
-            cv::cvtColor(img2, img2, cv::COLOR_BGR2GRAY);
-        }
+        img1 = toGray(img1);
+        img2 = toGray(img2);
         auto [t, L1, L2] = getLinearHybridImage(img1, a, img2, b, n);
         result = t;
         if (visual && verbose) viewLapPyr(L1, L2);
@@ -192,8 +232,8 @@ int main(int argc, char *argv[])
         cv::merge(split2, img2);
 
         // Got L1, L2 from GRAY image; compromised solution
-        cv::cvtColor(img1, img1, cv::COLOR_BGR2GRAY);
-        cv::cvtColor(img2, img2, cv::COLOR_BGR2GRAY);
+        img1 = toGray(img1);
+        img2 = toGray(img2);
         auto [r, L1, L2] = getLinearHybridImage(img1, a, img2, b, n);
         if (verbose) wirteOutLapPyr(L1, L2);
     }
@@ -206,6 +246,7 @@ int main(int argc, char *argv[])
     }
 
     std::cout << "Writing out result image to '" << imgPath3 << "'.\n";
-    cv::imwrite(imgPath3, result);
+    TRACE_SCOPE("imwrite");
+    writeImage(imgPath3, rawOut ? result : toByte(result));
     return 0;
 }
@@ -0,0 +1,123 @@
+#include "mapped_file.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path, Mode mode) {
+    bool writable = mode == Mode::WRITE;
+    bool copy = mode == Mode::COPY;
+#ifdef _WIN32
+    file_ = CreateFileA(path.c_str(), writable ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ,
+                        FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) {
+        file_ = nullptr;
+        throw std::runtime_error("Unable to open '" + path + "'.");
+    }
+    LARGE_INTEGER size;
+    GetFileSizeEx(file_, &size);
+    size_ = static_cast<std::size_t>(size.QuadPart);
+    if (size_ == 0) {
+        close();
+        throw std::runtime_error("'" + path + "' is empty.");
+    }
+    auto protect = writable ? PAGE_READWRITE : copy ? PAGE_WRITECOPY : PAGE_READONLY;
+    mapping_ = CreateFileMappingA(file_, nullptr, protect, 0, 0, nullptr);
+    if (mapping_ != nullptr) {
+        auto access = writable ? FILE_MAP_WRITE : copy ? FILE_MAP_COPY : FILE_MAP_READ;
+        data_ = static_cast<std::uint8_t*>(MapViewOfFile(mapping_, access, 0, 0, 0));
+    }
+#else
+    fd_ = ::open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+    if (fd_ < 0) {
+        throw std::runtime_error("Unable to open '" + path + "'.");
+    }
+    struct stat st;
+    ::fstat(fd_, &st);
+    size_ = static_cast<std::size_t>(st.st_size);
+    if (size_ == 0) {
+        close();
+        throw std::runtime_error("'" + path + "' is empty.");
+    }
+    void* p = ::mmap(nullptr, size_, (writable || copy) ? (PROT_READ | PROT_WRITE) : PROT_READ,
+                     copy ? MAP_PRIVATE : MAP_SHARED, fd_, 0);
+    if (p != MAP_FAILED) {
+        data_ = static_cast<std::uint8_t*>(p);
+    }
+#endif
+    if (data_ == nullptr) {
+        close();
+        throw std::runtime_error("Unable to map '" + path + "' into memory.");
+    }
+}
+
+MappedFile MappedFile::create(const std::string& path, std::size_t size) {
+    {
+        std::FILE* f = std::fopen(path.c_str(), "wb");
+        if (f == nullptr) {
+            throw std::runtime_error("Unable to create '" + path + "'.");
+        }
+        std::fclose(f);
+    }
+    std::filesystem::resize_file(path, size);
+    return MappedFile(path, Mode::WRITE);
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& o) noexcept {
+    *this = std::move(o);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& o) noexcept {
+    if (this != &o) {
+        close();
+        std::swap(data_, o.data_);
+        std::swap(size_, o.size_);
+#ifdef _WIN32
+        std::swap(file_, o.file_);
+        std::swap(mapping_, o.mapping_);
+#else
+        std::swap(fd_, o.fd_);
+#endif
+    }
+    return *this;
+}
+
+void MappedFile::flush() {
+    if (data_ == nullptr) return;
+#ifdef _WIN32
+    FlushViewOfFile(data_, 0);
+#else
+    ::msync(data_, size_, MS_SYNC);
+#endif
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+    if (data_ != nullptr) UnmapViewOfFile(data_);
+    if (mapping_ != nullptr) CloseHandle(mapping_);
+    if (file_ != nullptr) CloseHandle(file_);
+    mapping_ = nullptr;
+    file_ = nullptr;
+#else
+    if (data_ != nullptr) ::munmap(data_, size_);
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+#endif
+    data_ = nullptr;
+    size_ = 0;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// A file mapped into memory, read-only, read-write or copy-on-write.
+// Throws std::runtime_error if the file can't be opened or mapped.
+class MappedFile {
+public:
+    // COPY maps the file writable, but writes stay private to the process.
+    enum class Mode { READ, WRITE, COPY };
+
+    MappedFile() = default;
+    MappedFile(const std::string& path, Mode mode = Mode::READ);
+    ~MappedFile();
+
+    MappedFile(MappedFile&& o) noexcept;
+    MappedFile& operator=(MappedFile&& o) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Creates (or truncates) `path` with `size` bytes and maps it for writing.
+    static MappedFile create(const std::string& path, std::size_t size);
+
+    std::uint8_t* data() const { return data_; }
+    std::size_t size() const { return size_; }
+    bool isOpen() const { return data_ != nullptr; }
+
+    // Writes dirty pages back to the file.
+    void flush();
+    void close();
+
+private:
+    std::uint8_t* data_ = nullptr;
+    std::size_t size_ = 0;
+#ifdef _WIN32
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
@@ -0,0 +1,163 @@
+#include "rawmat.hpp"
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <opencv2/imgproc.hpp>
+#include "mapped_file.hpp"
+#include "trace.hpp"
+
+namespace {
+
+constexpr char MAGIC[8] = {'C', 'V', 'R', 'A', 'W', 'M', 'A', 'T'};
+constexpr std::uint32_t VERSION = 1;
+
+struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::int32_t rows;
+    std::int32_t cols;
+    std::int32_t type;
+    std::uint64_t step;         // bytes per row in the file
+    std::uint8_t reserved[32];
+};
+static_assert(sizeof(Header) == 64, "pixel data must start at offset 64");
+
+// Owner of the mapping behind a Mat returned by readRawMat: releasing the
+// last reference to the Mat unmaps the file.
+class MappedFileAllocator : public cv::MatAllocator {
+public:
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override {
+        // new buffers are never placed in a mapping
+        return cv::Mat::getDefaultAllocator()->allocate(dims, sizes, type, data, step, flags, usageFlags);
+    }
+
+    bool allocate(cv::UMatData*, cv::AccessFlag, cv::UMatUsageFlags) const override {
+        return false;
+    }
+
+    void deallocate(cv::UMatData* u) const override {
+        if (u == nullptr) return;
+        delete static_cast<MappedFile*>(u->userdata);
+        u->userdata = nullptr;
+        delete u;
+    }
+};
+
+MappedFileAllocator* mappedFileAllocator() {
+    static auto a = new MappedFileAllocator;
+    return a;
+}
+
+}
+
+bool isRawMatPath(const std::string& path) {
+    return std::filesystem::path(path).extension() == RAW_MAT_EXT;
+}
+
+cv::Mat readRawMat(const std::string& path) {
+    TRACE_SCOPE("rawmat read");
+    auto file = std::make_unique<MappedFile>(path, MappedFile::Mode::COPY);
+
+    Header h;
+    if (file->size() < sizeof(h)) {
+        throw std::runtime_error("'" + path + "' is not a raw image.");
+    }
+    std::memcpy(&h, file->data(), sizeof(h));
+    if (std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0 || h.version != VERSION) {
+        throw std::runtime_error("'" + path + "' is not a raw image.");
+    }
+    // every field is untrusted: check the type bits before using them, and
+    // bound the step by division so that step * rows can't wrap around
+    auto available = file->size() - sizeof(h);
+    if (h.rows <= 0 || h.cols <= 0 ||
+        (h.type & ~CV_MAT_TYPE_MASK) != 0 || CV_MAT_CN(h.type) > CV_CN_MAX ||
+        h.step < static_cast<std::uint64_t>(h.cols) * CV_ELEM_SIZE(h.type) ||
+        h.step > available / static_cast<std::uint64_t>(h.rows)) {
+        throw std::runtime_error("'" + path + "' is corrupted.");
+    }
+
+    auto data = file->data() + sizeof(h);
+    cv::Mat mat(h.rows, h.cols, h.type, data, static_cast<size_t>(h.step));
+
+    // hand the mapping over to the Mat's reference counting
+    auto u = new cv::UMatData(mappedFileAllocator());
+    u->data = u->origdata = data;
+    u->size = static_cast<size_t>(h.step * h.rows);
+    u->refcount = 1;
+    u->userdata = file.release();
+    mat.u = u;
+    return mat;
+}
+
+void writeRawMat(const std::string& path, cv::Mat const & mat) {
+    TRACE_SCOPE("rawmat write");
+    CV_Assert(mat.dims == 2 && !mat.empty());
+
+    Header h{};
+    std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = VERSION;
+    h.rows = mat.rows;
+    h.cols = mat.cols;
+    h.type = mat.type();
+    h.step = mat.cols * mat.elemSize();
+
+    std::ofstream ofs(path, std::ios::binary);
+    if (!ofs.is_open()) {
+        throw std::runtime_error("Unable to open '" + path + "'.");
+    }
+    ofs.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    if (mat.isContinuous()) {
+        ofs.write(mat.ptr<char>(), static_cast<std::streamsize>(h.step * h.rows));
+    } else {
+        for (int r = 0; r < mat.rows; ++r) {
+            ofs.write(mat.ptr<char>(r), static_cast<std::streamsize>(h.step));
+        }
+    }
+    if (!ofs) {
+        throw std::runtime_error("Unable to write '" + path + "'.");
+    }
+}
+
+cv::Mat readImage(const std::string& path, int flags) {
+    if (!isRawMatPath(path)) {
+        return cv::imread(path, flags);
+    }
+    try {
+        auto mat = readRawMat(path);
+        // channels follow the colour flags, as with cv::imread; the depth is kept
+        // as stored, and IMREAD_UNCHANGED returns the mapping without a copy
+        if (flags == cv::IMREAD_UNCHANGED) return mat;
+        if (flags & cv::IMREAD_COLOR) {
+            if (mat.channels() == 1) cv::cvtColor(mat, mat, cv::COLOR_GRAY2BGR);
+            else if (mat.channels() == 4) cv::cvtColor(mat, mat, cv::COLOR_BGRA2BGR);
+        } else {
+            if (mat.channels() == 3) cv::cvtColor(mat, mat, cv::COLOR_BGR2GRAY);
+            else if (mat.channels() == 4) cv::cvtColor(mat, mat, cv::COLOR_BGRA2GRAY);
+        }
+        return mat;
+    } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << "\n";
+        return {};
+    } catch (const cv::Exception& e) {
+        std::cerr << e.what() << "\n";
+        return {};
+    }
+}
+
+bool writeImage(const std::string& path, cv::Mat const & mat) {
+    if (!isRawMatPath(path)) {
+        return cv::imwrite(path, mat);
+    }
+    try {
+        writeRawMat(path, mat);
+        return true;
+    } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << "\n";
+        return false;
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+// Raw container for intermediate images passed between the tools.
+//
+// A 64-byte header (magic "CVRAWMAT", version, rows, cols, OpenCV type, row
+// step) followed by the rows of pixel data, starting at offset 64. Any depth
+// and channel count is kept as is, so e.g. CV_32F results survive a round
+// trip without quantisation. Values are stored in native byte order.
+
+// Extension that selects the raw container in readImage / writeImage.
+inline const std::string RAW_MAT_EXT = ".rawmat";
+
+bool isRawMatPath(const std::string& path);
+
+// Maps the file copy-on-write and returns a cv::Mat header over its pixels,
+// without copying. The mapping lives as long as the Mat (or any copy of it)
+// does; writing to the Mat does not modify the file.
+// Throws std::runtime_error if the file is missing or malformed.
+cv::Mat readRawMat(const std::string& path);
+
+// Throws std::runtime_error if the file can't be written.
+void writeRawMat(const std::string& path, cv::Mat const & mat);
+
+// cv::imread, except that raw containers are mapped by readRawMat. For those,
+// IMREAD_COLOR / IMREAD_GRAYSCALE convert the channels (the depth is kept), and
+// IMREAD_UNCHANGED returns the mapping as stored. Returns an empty Mat on failure.
+cv::Mat readImage(const std::string& path, int flags = cv::IMREAD_COLOR);
+
+// cv::imwrite, except that raw containers are written by writeRawMat.
+bool writeImage(const std::string& path, cv::Mat const & mat);
@@ -0,0 +1,220 @@
+#include "trace.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <opencv2/core.hpp>
+
+namespace trace {
+
+namespace {
+
+struct Event {
+    const char* name;
+    int tid;
+    double ts;      // us since the session started
+    double dur;     // us; negative for counter samples
+    std::int64_t value;
+};
+
+struct State {
+    std::mutex mutex;
+    Clock::time_point start;
+    std::vector<Event> events;
+    std::map<std::string, std::int64_t> counters;
+    std::atomic<std::int64_t> live{0};
+    std::atomic<std::int64_t> peak{0};
+};
+
+State& state() {
+    static State s;
+    return s;
+}
+
+double since(Clock::time_point t) {
+    return std::chrono::duration<double, std::micro>(t - state().start).count();
+}
+
+int threadIndex() {
+    static std::atomic<int> next{0};
+    thread_local int index = next++;
+    return index;
+}
+
+// Wraps OpenCV's default allocator to keep track of the bytes held by cv::Mat.
+class TrackingAllocator : public cv::MatAllocator {
+public:
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override {
+        auto u = cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usageFlags);
+        if (u != nullptr) {
+            // route the release back through this allocator
+            u->currAllocator = u->prevAllocator = this;
+            if (!(u->flags & cv::UMatData::USER_ALLOCATED)) add(static_cast<std::int64_t>(u->size));
+        }
+        return u;
+    }
+
+    bool allocate(cv::UMatData* u, cv::AccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const override {
+        return cv::Mat::getStdAllocator()->allocate(u, accessFlags, usageFlags);
+    }
+
+    void deallocate(cv::UMatData* u) const override {
+        if (u != nullptr && !(u->flags & cv::UMatData::USER_ALLOCATED)) add(-static_cast<std::int64_t>(u->size));
+        cv::Mat::getStdAllocator()->deallocate(u);
+    }
+
+private:
+    static void add(std::int64_t bytes) {
+        auto& s = state();
+        if (bytes > 0) detail::allocated += bytes;
+        auto live = s.live += bytes;
+        auto peak = s.peak.load();
+        while (live > peak && !s.peak.compare_exchange_weak(peak, live)) {}
+    }
+};
+
+// Deliberately leaked: Mats may still be released through it during static destruction.
+TrackingAllocator* trackingAllocator() {
+    static auto a = new TrackingAllocator;
+    return a;
+}
+
+// Only stage names are written, and they are string literals; escape anyway.
+std::string jsonString(const std::string& s) {
+    std::string r = "\"";
+    for (auto c : s) {
+        if (c == '"' || c == '\\') r += '\\';
+        if (static_cast<unsigned char>(c) >= 0x20) r += c;
+    }
+    return r + "\"";
+}
+
+void writeTrace(const std::string& path) {
+    std::ofstream ofs(path);
+    if (!ofs.is_open()) {
+        std::cerr << "Unable to open '" << path << "'.\n";
+        return;
+    }
+    auto& s = state();
+    ofs << std::fixed << std::setprecision(3);
+    ofs << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    for (auto const & e : s.events) {
+        if (!first) ofs << ",\n";
+        first = false;
+        if (e.dur >= 0) {
+            ofs << "{\"name\":" << jsonString(e.name) << ",\"cat\":\"stage\",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.tid
+                << ",\"ts\":" << e.ts << ",\"dur\":" << e.dur
+                << ",\"args\":{\"allocated_bytes\":" << e.value << "}}";
+        } else {
+            ofs << "{\"name\":" << jsonString(e.name) << ",\"ph\":\"C\",\"pid\":1,\"tid\":" << e.tid
+                << ",\"ts\":" << e.ts << ",\"args\":{\"value\":" << e.value << "}}";
+        }
+    }
+    ofs << "\n]}\n";
+}
+
+void printStats() {
+    struct Stage {
+        int calls = 0;
+        double total = 0;
+        double max = 0;
+        std::int64_t bytes = 0;
+    };
+    auto& s = state();
+    std::map<std::string, Stage> stages;
+    for (auto const & e : s.events) {
+        if (e.dur < 0) continue;
+        auto& st = stages[e.name];
+        ++st.calls;
+        st.total += e.dur;
+        st.max = std::max(st.max, e.dur);
+        st.bytes += e.value;
+    }
+
+    std::vector<std::pair<std::string, Stage>> sorted(stages.begin(), stages.end());
+    std::sort(sorted.begin(), sorted.end(), [](auto const & a, auto const & b) {
+        return a.second.total > b.second.total;
+    });
+
+    auto& o = std::cerr;
+    o << std::fixed << std::setprecision(2);
+    o << std::left << std::setw(24) << "stage" << std::right
+      << std::setw(8) << "calls" << std::setw(12) << "total ms" << std::setw(12) << "mean ms"
+      << std::setw(12) << "max ms" << std::setw(12) << "alloc MB" << "\n";
+    for (auto const & [name, st] : sorted) {
+        o << std::left << std::setw(24) << name << std::right
+          << std::setw(8) << st.calls << std::setw(12) << st.total / 1000 << std::setw(12) << st.total / 1000 / st.calls
+          << std::setw(12) << st.max / 1000 << std::setw(12) << st.bytes / 1048576.0 << "\n";
+    }
+    for (auto const & [name, value] : s.counters) {
+        o << std::left << std::setw(24) << name << std::right << std::setw(8) << value << "\n";
+    }
+    o << "Peak cv::Mat memory: " << s.peak / 1048576.0 << " MB" << std::endl;
+}
+
+}
+
+namespace detail {
+
+void record(const char* name, Clock::time_point start, Clock::time_point end, std::int64_t bytes) {
+    auto& s = state();
+    Event e{name, threadIndex(), since(start), std::chrono::duration<double, std::micro>(end - start).count(), bytes};
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.events.push_back(e);
+}
+
+void count(const char* name, std::int64_t delta) {
+    auto& s = state();
+    auto ts = since(Clock::now());
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto value = s.counters[name] += delta;
+    s.events.push_back({name, threadIndex(), ts, -1, value});
+}
+
+}
+
+Session::Session(int& argc, char** argv) {
+    int out = std::min(argc, 1);
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--trace") == 0) {
+            if (i + 1 < argc) {
+                tracePath_ = argv[++i];
+            } else {
+                std::cerr << "--trace expects a file name; tracing is disabled.\n";
+            }
+        } else if (std::strncmp(argv[i], "--trace=", 8) == 0) {
+            tracePath_ = argv[i] + 8;
+        } else if (std::strcmp(argv[i], "--stats") == 0) {
+            stats_ = true;
+        } else {
+            argv[out++] = argv[i];
+        }
+    }
+    argc = out;
+    argv[argc] = nullptr;
+
+    if (tracePath_.empty() && !stats_) return;
+
+    state().start = Clock::now();
+    cv::Mat::setDefaultAllocator(trackingAllocator());
+    detail::enabled = true;
+}
+
+Session::~Session() {
+    if (!enabled()) return;
+    detail::enabled = false;
+    // Mats allocated meanwhile still release through the tracking allocator
+    cv::Mat::setDefaultAllocator(cv::Mat::getStdAllocator());
+
+    std::lock_guard<std::mutex> lock(state().mutex);
+    if (!tracePath_.empty()) writeTrace(tracePath_);
+    if (stats_) printStats();
+}
+
+}
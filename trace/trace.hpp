@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Lightweight instrumentation shared by all tools.
+//
+//     int main(int argc, char* argv[]) {
+//         trace::Session session(argc, argv);   // consumes --trace <file> and --stats
+//         ...
+//         {
+//             TRACE_SCOPE("imread");
+//             img = cv::imread(path);
+//         }
+//         trace::count("tiles", n);
+//     }
+//
+// While neither flag is given, scopes and counters only test a flag.
+
+namespace trace {
+
+using Clock = std::chrono::steady_clock;
+
+namespace detail {
+    inline std::atomic<bool> enabled{false};
+    inline std::atomic<std::int64_t> allocated{0};  // bytes ever allocated by cv::Mat
+
+    void record(const char* name, Clock::time_point start, Clock::time_point end, std::int64_t bytes);
+    void count(const char* name, std::int64_t delta);
+}
+
+inline bool enabled() {
+    return detail::enabled.load(std::memory_order_relaxed);
+}
+
+// Times the enclosing scope as one stage; also records the cv::Mat bytes allocated meanwhile.
+class Scope {
+public:
+    explicit Scope(const char* name) : name_(name) {
+        if (enabled()) {
+            active_ = true;
+            bytes_ = detail::allocated.load(std::memory_order_relaxed);
+            start_ = Clock::now();
+        }
+    }
+    ~Scope() {
+        if (active_) {
+            detail::record(name_, start_, Clock::now(), detail::allocated.load(std::memory_order_relaxed) - bytes_);
+        }
+    }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    const char* name_;
+    bool active_ = false;
+    std::int64_t bytes_ = 0;
+    Clock::time_point start_;
+};
+
+// Adds `delta` to the counter `name`.
+inline void count(const char* name, std::int64_t delta = 1) {
+    if (enabled()) detail::count(name, delta);
+}
+
+// Enables tracing for the lifetime of the object if `--trace <file>` or `--stats`
+// is on the command line. Both flags are removed from argc / argv, so the tool's
+// own argument parsing is unaffected. On destruction the trace is written in
+// Chrome trace-event format and / or a per-stage summary is printed to stderr.
+class Session {
+public:
+    Session(int& argc, char** argv);
+    ~Session();
+    Session(const Session&) = delete;
+    Session& operator=(const Session&) = delete;
+
+private:
+    std::string tracePath_;
+    bool stats_ = false;
+};
+
+}
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) ::trace::Scope TRACE_CONCAT(trace_scope_, __LINE__){name}